@@ -0,0 +1,184 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iterator>
+#include <new>
+#include <vector>
+
+// An immutable, read-only snapshot of a sorted set of keys
+//
+// Keys are stored contiguously in Eytzinger (BFS) order: the children of
+// slot k live at 2k and 2k+1, slot 0 is unused. A lookup walks from the root
+// with a branchless descent, and the top levels of the tree share cache lines
+// so a search costs a handful of cache misses instead of one per element.
+//
+// Built by LazyList::freeze(), and turned back into a mutable list with
+// LazyList's FrozenList constructor.
+
+// Hands out storage starting on a cache line, so that FrozenList can tell
+// which lines a group of slots spans
+template <typename T>
+class CacheAlignedAllocator
+{
+    public:
+        typedef T value_type;
+
+        CacheAlignedAllocator() {}
+
+        template <typename U>
+        CacheAlignedAllocator(const CacheAlignedAllocator<U>&) {}
+
+        T* allocate(size_t n)
+        {
+            void* p = nullptr;
+            if(posix_memalign(&p, 64, n * sizeof(T)) != 0)
+                throw std::bad_alloc();
+
+            return static_cast<T*>(p);
+        }
+
+        void deallocate(T* p, size_t) { free(p); }
+};
+
+template <typename T, typename U>
+bool operator==(const CacheAlignedAllocator<T>&, const CacheAlignedAllocator<U>&) { return true; }
+
+template <typename T, typename U>
+bool operator!=(const CacheAlignedAllocator<T>&, const CacheAlignedAllocator<U>&) { return false; }
+
+class FrozenList
+{
+    public:
+        // In-order (ascending) traversal of the Eytzinger layout
+        class const_iterator
+        {
+            public:
+                typedef std::forward_iterator_tag iterator_category;
+                typedef uintptr_t value_type;
+                typedef std::ptrdiff_t difference_type;
+                typedef const uintptr_t* pointer;
+                typedef const uintptr_t& reference;
+
+                const_iterator() : keys(nullptr), n(0), k(0) {}
+
+                reference operator*() const { return keys[k]; }
+                pointer operator->() const { return &keys[k]; }
+
+                const_iterator& operator++()
+                {
+                    if(2 * k + 1 <= n)
+                    {
+                        // Left-most node of the right sub-tree
+                        k = 2 * k + 1;
+                        while(2 * k <= n)
+                            k = 2 * k;
+                    }
+                    else
+                    {
+                        // Climb while we are a right child, then once more
+                        while(k & 0x1)
+                            k >>= 1;
+                        k >>= 1;
+                    }
+
+                    return *this;
+                }
+
+                const_iterator operator++(int)
+                {
+                    const_iterator t = *this;
+                    ++(*this);
+                    return t;
+                }
+
+                bool operator==(const const_iterator& o) const { return k == o.k; }
+                bool operator!=(const const_iterator& o) const { return k != o.k; }
+
+            private:
+                friend class FrozenList;
+
+                const_iterator(const uintptr_t* d, size_t count, size_t idx)
+                    : keys(d), n(count), k(idx)
+                {}
+
+                const uintptr_t* keys;
+                size_t n;
+                size_t k;
+        };
+
+        FrozenList() : keys(1, 0), count(0) {}
+
+        // Input must be in ascending order, out-of-order or repeated values are
+        // dropped.
+        template <typename InputIt>
+        FrozenList(InputIt first, InputIt last)
+            : keys(1, 0), count(0)
+        {
+            std::vector<uintptr_t> sorted;
+            for(; first != last; ++first)
+            {
+                uintptr_t v = *first;
+                if(sorted.empty() || sorted.back() < v)
+                    sorted.push_back(v);
+            }
+
+            count = sorted.size();
+            keys.resize(count + 1);
+
+            size_t i = 0;
+            build(sorted, i, 1);
+        }
+
+        bool contains(uintptr_t value) const
+        {
+            const uintptr_t* data = keys.data();
+            size_t k = 1;
+            while(k <= count)
+            {
+                // The 16 descendants four levels down are contiguous and,
+                // with 'keys' cache-line aligned, fill exactly two lines.
+                // Start fetching both now, prefetching past the end is
+                // harmless.
+                __builtin_prefetch(data + k * 16);
+                __builtin_prefetch(data + k * 16 + 8);
+                k = 2 * k + (data[k] < value);
+            }
+
+            // Undo the trailing right turns (plus the final left one) to land on
+            // the lower bound
+            k >>= __builtin_ffsll(~k);
+
+            return k != 0 && data[k] == value;
+        }
+
+        size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+
+        const_iterator begin() const
+        {
+            size_t k = (count == 0) ? 0 : 1;
+            while(k != 0 && 2 * k <= count)
+                k = 2 * k;
+
+            return const_iterator(keys.data(), count, k);
+        }
+
+        const_iterator end() const { return const_iterator(keys.data(), count, 0); }
+
+    private:
+        // In-order fill of the implicit tree rooted at 'k'
+        void build(const std::vector<uintptr_t>& sorted, size_t& i, size_t k)
+        {
+            if(k > count)
+                return;
+
+            build(sorted, i, 2 * k);
+            keys[k] = sorted[i++];
+            build(sorted, i, 2 * k + 1);
+        }
+
+        std::vector<uintptr_t, CacheAlignedAllocator<uintptr_t>> keys;
+        size_t count;
+};
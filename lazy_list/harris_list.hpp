@@ -0,0 +1,195 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Traversal and marking shared by LazyList and LazyMap
+//
+// A Harris-style sorted list over any node type 'N' that has a 'next'
+// pointer, whose low bit is the deletion mark, and a uintptr_t 'Key' member
+// it is ordered by. The derived list decides what a node carries and how it
+// gets linked in; searching, lookups, logical removal and pruning live here
+// so both lists get the same fixes.
+
+template <typename N, uintptr_t N::*Key>
+class HarrisList
+{
+    public:
+        // This is basically a re-implementation of MarkableReference
+        static inline bool is_marked(N* n) { return (uintptr_t)n & 0x1; }
+        static inline N* clear_mark(N* n)
+        {
+            uintptr_t t = reinterpret_cast<uintptr_t>(n) & ~0x1ull;
+            return reinterpret_cast<N*>(t);
+        }
+
+        static inline N* set_mark(N* n)
+        {
+            uintptr_t t = reinterpret_cast<uintptr_t>(n) | 0x1ull;
+            return reinterpret_cast<N*>(t);
+        }
+
+        static inline N* get_unmarked(N* n)
+        {
+            return reinterpret_cast<N*>(reinterpret_cast<uintptr_t>(n) & ~0x1ull);
+        }
+
+        static inline N* get_marked(N* n)
+        {
+            return reinterpret_cast<N*>(reinterpret_cast<uintptr_t>(n) | 0x1ull);
+        }
+
+        // Every read of a 'next' that other threads may be CAS'ing goes through
+        // here. A plain load lets the compiler hoist it out of retry loops or
+        // re-load it between a check and a use.
+        static inline N* load_next(N* n)
+        {
+            return __atomic_load_n(&(n->next), __ATOMIC_ACQUIRE);
+        }
+
+        // 'start' optionally lets the walk begin at a node known to precede
+        // 'key', it falls back to 'head' once that node has been removed.
+        N* search(uintptr_t key, N **left, N* start = nullptr)
+        {
+            N* left_next = nullptr, *right = nullptr;
+
+            while(true)
+            {
+                N* pred = start ? start : head;
+                N* curr = load_next(pred);
+                if(is_marked(curr))
+                {
+                    start = nullptr;
+                    pred = head;
+                    curr = load_next(head);
+                }
+
+                while(is_marked(curr) || (pred->*Key < key))
+                {
+                    if(!is_marked(curr))
+                    {
+                        *left = pred;
+                        left_next = curr;
+                    }
+
+                    pred = get_unmarked(curr);
+                    if(pred == tail)
+                        break;
+
+                    curr = load_next(pred);
+                }
+
+                right = pred;
+
+                if(left_next == right)
+                {
+                    if(!is_marked(load_next(right)))
+                        return right;
+                }
+                else
+                {
+                    // If you reach here, you're in trouble.
+                    // This is due to an un-pruned node sticking around,
+                    // which means you're misusing the data structure.
+                }
+            }
+        }
+
+        // Search for marked node with this key and unlink the run of marked
+        // nodes it sits in with a single CAS, appending every one of them to
+        // 'pruned'. Returns false if there was nothing left to unlink.
+        bool prune(uintptr_t key, std::vector<N*>* pruned)
+        {
+            N *right = nullptr, *left_next = nullptr, *left = nullptr;
+            while(true)
+            {
+                N* pred = head;
+                N* curr = load_next(head);
+
+                while(is_marked(curr) || (pred->*Key < key))
+                {
+                    if(!is_marked(curr))
+                    {
+                        left = pred;
+                        left_next = curr;
+                    }
+
+                    pred = get_unmarked(curr);
+                    if(pred == tail)
+                        break;
+
+                    curr = load_next(pred);
+                }
+
+                right = pred;
+
+                if(left_next == right)
+                {
+                    // Nothing left to unlink, someone else beat us to it
+                    return false;
+                }
+
+                // Physically remove logically-removed nodes. A marked node's
+                // 'next' never changes again, so the run can still be walked.
+                if(__sync_val_compare_and_swap(&(left->next), left_next, right) == left_next)
+                {
+                    for(N* r = left_next; r != right; r = get_unmarked(load_next(r)))
+                        pruned->push_back(r);
+
+                    return true;
+                }
+            }
+        }
+
+    protected:
+        HarrisList(N* h, N* t) : head(h), tail(t)
+        {
+            head->next = tail;
+        }
+
+        // The live node holding 'key', or nullptr. Never writes, so it can't
+        // stall on an un-pruned node.
+        N* find(uintptr_t key)
+        {
+            N* itr = get_unmarked(load_next(head));
+            while(itr != tail)
+            {
+                if(!is_marked(load_next(itr)) && itr->*Key >= key)
+                {
+                    return (itr->*Key == key) ? itr : nullptr;
+                }
+
+                itr = get_unmarked(load_next(itr));
+            }
+
+            return nullptr;
+        }
+
+        // Logical half of remove(): marks the node holding 'key', returns
+        // false if there is none
+        bool mark(uintptr_t key)
+        {
+            N *right = nullptr, *left = nullptr, *right_next = nullptr;
+
+            while(true)
+            {
+                right = search(key, &left);
+
+                if(right == tail || right->*Key != key)
+                    return false;
+
+                right_next = load_next(right);
+                if(!is_marked(right_next))
+                {
+                    // Logically remove node
+                    if(__sync_val_compare_and_swap(&(right->next), right_next, get_marked(right_next)) == right_next)
+                    {
+                        return true;
+                    }
+                }
+            }
+        }
+
+        N* head;
+        N* tail;
+};
@@ -1,8 +1,17 @@
+#pragma once
+
+#include <cstddef>
 #include <cstdint>
+#include <iterator>
 #include <limits>
+#include <vector>
 
 #include <cstdio>
 
+#include "frozen_list.hpp"
+#include "harris_list.hpp"
+#include "sharded_counter.hpp"
+
 // A Psuedo-Lazily-Synchronized Linked List
 // Based on this implementation: https://github.com/jserv/concurrent-ll/
 // Derived from: "A Pragmatic Implementation of Non-Blocking Linked-Lists" by Timothy L. Harris
@@ -17,16 +26,46 @@ class Node
         uintptr_t value;
 };
 
-class LazyList
+class LazyList : public HarrisList<Node, &Node::value>
 {
     public:
         LazyList()
-            : head(new Node(0)),
-              tail(new Node(std::numeric_limits<uintptr_t>::max()))
+            : HarrisList(new Node(0), new Node(std::numeric_limits<uintptr_t>::max()))
+        {}
+
+        // Bulk-load from values in ascending order in a single linear pass,
+        // without searching from 'head' per value. Out-of-order, repeated and
+        // sentinel values are dropped.
+        template <typename InputIt>
+        LazyList(InputIt first, InputIt last)
+            : LazyList()
         {
-            head->next = tail;
+            Node* pred = head;
+            int64_t count = 0;
+            for(; first != last; ++first)
+            {
+                uintptr_t v = *first;
+                if(v <= pred->value || v >= tail->value)
+                    continue;
+
+                Node* n = new Node(v);
+                pred->next = n;
+                pred = n;
+                count++;
+            }
+
+            pred->next = tail;
+            num_inserts.add(count);
         }
 
+        // Thaw a frozen snapshot back into a mutable list
+        explicit LazyList(const FrozenList& frozen)
+            : LazyList(frozen.begin(), frozen.end())
+        {}
+
+        LazyList(const LazyList&) = delete;
+        LazyList& operator=(const LazyList&) = delete;
+
         ~LazyList()
         {
             Node* c = head;
@@ -38,120 +77,90 @@ class LazyList
             }
         }
 
-        // This is basically a re-implementation of MarkableReference
-        inline bool is_marked(Node* n) { return (uintptr_t)n & 0x1; }
-        inline Node* clear_mark(Node* n)
-        {
-            uintptr_t t = reinterpret_cast<uintptr_t>(n) & ~0x1ull;
-            return reinterpret_cast<Node*>(t);
-        }
-
-        inline Node* set_mark(Node* n)
+        // Forward iterator over the logically present values of the list, in
+        // ascending order. Marked (logically deleted) nodes are skipped.
+        //
+        // Iteration is weakly consistent: it never allocates or takes locks,
+        // and a concurrent add/remove may or may not be observed. There is no
+        // reclamation scheme beyond the one 'remove' already imposes, so
+        // nodes handed out through 'remove'/'prune' must not be freed while an
+        // iterator may still be walking over them.
+        class const_iterator
         {
-            uintptr_t t = reinterpret_cast<uintptr_t>(n) | 0x1ull;
-            return reinterpret_cast<Node*>(t);
-        }
+            public:
+                typedef std::forward_iterator_tag iterator_category;
+                typedef uintptr_t value_type;
+                typedef std::ptrdiff_t difference_type;
+                typedef const uintptr_t* pointer;
+                typedef const uintptr_t& reference;
 
-        inline Node* get_unmarked(Node* n)
-        {
-            return reinterpret_cast<Node*>(reinterpret_cast<uintptr_t>(n) & ~0x1ull);
-        }
+                const_iterator() : curr(nullptr), tail(nullptr) {}
 
-        inline Node* get_marked(Node* n)
-        {
-            return reinterpret_cast<Node*>(reinterpret_cast<uintptr_t>(n) | 0x1ull);
-        }
-
-        Node* search(uintptr_t value, Node **left)
-        {
-            Node* left_next = nullptr, *right = nullptr;
+                reference operator*() const { return curr->value; }
+                pointer operator->() const { return &curr->value; }
 
-            while(true)
-            {
-                Node* pred = head;
-                Node* curr = head->next;
+                const_iterator& operator++()
+                {
+                    curr = get_unmarked(load_next(curr));
+                    skip_marked();
+                    return *this;
+                }
 
-                while(is_marked(curr) || (pred->value < value))
+                const_iterator operator++(int)
                 {
-                    if(!is_marked(curr))
-                    {
-                        *left = pred;
-                        left_next = curr;
-                    }
+                    const_iterator t = *this;
+                    ++(*this);
+                    return t;
+                }
 
-                    pred = get_unmarked(curr);
-                    if(pred == tail)
-                        break;
+                bool operator==(const const_iterator& o) const { return curr == o.curr; }
+                bool operator!=(const const_iterator& o) const { return curr != o.curr; }
 
-                    curr = pred->next;
-                }
+            private:
+                friend class LazyList;
 
-                right = pred;
+                const_iterator(Node* c, Node* t) : curr(c), tail(t) { skip_marked(); }
 
-                if(left_next == right)
+                void skip_marked()
                 {
-                    if(!is_marked(right->next))
-                        return right;
+                    Node* n;
+                    while(curr != tail && is_marked(n = load_next(curr)))
+                        curr = get_unmarked(n);
                 }
-                else
-                {
-                    // If you reach here, you're in trouble.
-                    // This is due to an un-pruned node sticking around,
-                    // which means you're misusing the data structure.
-                }
-            }
-        }
+
+                Node* curr;
+                Node* tail;
+        };
+
+        typedef const_iterator iterator;
+
+        const_iterator begin() const { return const_iterator(get_unmarked(load_next(head)), tail); }
+        const_iterator end() const { return const_iterator(tail, tail); }
+
+        // Snapshot the currently present values into a contiguous, read-only
+        // index. Concurrent updates may or may not be captured.
+        FrozenList freeze() const { return FrozenList(begin(), end()); }
 
         // Searches for given value in list, and can return the found node
         bool contains(uintptr_t value, Node **node = nullptr)
         {
-            Node* itr = get_unmarked(head->next);
-            while(itr != tail)
-            {
-                if(!is_marked(itr->next) && itr->value >= value)
-                {
-                    if(itr->value == value)
-                    {
-                        if(node)
-                            *node = itr;
-
-                        return true;
-                    }
-                    else
-                    {
-                        return false;
-                    }
-                }
-
-                itr = get_unmarked(itr->next);
-            }
+            Node* n = find(value);
+            if(n && node)
+                *node = n;
 
-            return false;
+            return n != nullptr;
         }
 
         bool add(uintptr_t value)
         {
-            Node* right = nullptr, *left = nullptr;
             Node* node = new Node(value);
-
-            while(true)
+            if(!link(node))
             {
-                right = search(value, &left);
-                if(right != tail && right->value == value)
-                {
-                    delete node;
-                    return false;
-                }
-
-                // TODO: Is this worth it? Only construct if we know we're gonna insert
-                //Node* node = new Node(value);
-                node->next = right;
-                if(__sync_val_compare_and_swap(&(left->next), right, node) == right)
-                {
-                    return true;
-                }
-                //delete node;
+                delete node;
+                return false;
             }
+
+            return true;
         }
 
         // Logically and/or physically removes node from list
@@ -159,74 +168,148 @@ class LazyList
         // If you choose not to physically remove (via passing in a valid
         // 'removed'), a consequent operation may stall forever until the
         // node is pruned. You have been warned.
-        bool remove(uintptr_t value, Node **removed = nullptr)
+        //
+        // Pruning unlinks the whole run of marked nodes around this one, so
+        // 'removed' may come back with other removers' nodes in it, or with
+        // none at all if a concurrent prune()/remove_range() unlinked this
+        // node first. Whoever unlinks a node owns it.
+        bool remove(uintptr_t value, std::vector<Node*>* removed = nullptr)
         {
-            Node *right = nullptr, *left = nullptr, *right_next = nullptr;
+            if(!mark(value))
+                return false;
 
-            while(true)
+            num_removes.increment();
+
+            if(removed)
             {
-                right = search(value, &left);
+                prune(value, removed);
+            }
 
-                if(right == tail || right->value != value)
-                    return false;
+            return true;
+        }
 
-                right_next = right->next;
-                if(!is_marked(right_next))
+        // Logically removes every value in [lo, hi], one marking CAS per node,
+        // and returns how many this call removed. The range as a whole is not
+        // removed atomically: values added behind the marking pass survive.
+        //
+        // When 'removed' is given, each run of marked nodes in the range is
+        // then unlinked with a single CAS on its live predecessor and the
+        // unlinked nodes are appended to 'removed' for the caller to free once
+        // no reader can still be walking them. That may include nodes marked
+        // by a concurrent remove(), whose own prune then comes back empty, and
+        // remove_range()'s own nodes may likewise end up with a remove().
+        // Without 'removed' the same caveat as remove() applies.
+        size_t remove_range(uintptr_t lo, uintptr_t hi, std::vector<Node*>* removed = nullptr)
+        {
+            if(lo <= head->value)
+                lo = head->value + 1;
+            if(hi >= tail->value)
+                hi = tail->value - 1;
+            if(lo > hi)
+                return 0;
+
+            size_t count = 0;
+
+            Node* left = nullptr;
+            Node* c = search(lo, &left);
+            while(c != tail && c->value <= hi)
+            {
+                Node* c_next = load_next(c);
+                if(!is_marked(c_next))
                 {
-                    // Logically remove node
-                    if(__sync_val_compare_and_swap(&(right->next), right_next, get_marked(right_next)))
-                    {
-                        break;
-                    }
+                    // Logically remove node, on failure re-read its successor
+                    if(__sync_val_compare_and_swap(&(c->next), c_next, get_marked(c_next)) != c_next)
+                        continue;
+
+                    num_removes.increment();
+                    count++;
                 }
+
+                c = get_unmarked(c_next);
             }
 
             if(removed)
             {
-                prune(value, removed);
+                unlink_range(left, lo, hi, removed);
             }
 
-            return true;
+            return count;
         }
 
-        // Search for marked node with this value
-        bool prune(uintptr_t value, Node **pruned)
+        // Removes every value, see remove_range()
+        size_t clear(std::vector<Node*>* removed = nullptr)
         {
-            Node *right = nullptr, *left_next = nullptr, *left = nullptr;
-            while(true)
-            {
-                Node* pred = head;
-                Node* curr = head->next;
-
-                while(is_marked(curr) || (pred->value < value))
-                {
-                    if(!is_marked(curr))
-                    {
-                        left = pred;
-                        left_next = curr;
-                    }
+            return remove_range(head->value + 1, tail->value - 1, removed);
+        }
 
-                    pred = get_unmarked(curr);
-                    if(pred == tail)
-                        break;
+        // Splices every value of 'other' into this list in one ascending pass
+        // and returns how many were added. Each splice starts searching from
+        // the previously spliced node, so merging lists with disjoint keys
+        // costs a single walk of this list. Values already present here are
+        // dropped.
+        //
+        // This list may be in concurrent use, 'other' must not be, and is left
+        // empty.
+        size_t merge(LazyList& other)
+        {
+            size_t merged = 0;
+            int64_t taken = 0;
+            Node* hint = nullptr;
 
-                    curr = pred->next;
-                }
+            Node* c = get_unmarked(other.head->next);
+            other.head->next = other.tail;
 
-                right = pred;
+            while(c != other.tail)
+            {
+                Node* c_next = c->next;
+                bool live = !is_marked(c_next);
+                if(live)
+                    taken++;
 
-                if(left_next != right)
+                if(live && link(c, hint))
                 {
-                    // Physically remove logically-removed node
-                    if(__sync_val_compare_and_swap(&(left->next), left_next, right) == left_next)
-                    {
-                        *pruned = left_next;
-                        return true;
-                    }
+                    hint = c;
+                    merged++;
+                }
+                else
+                {
+                    delete c;
                 }
+
+                c = get_unmarked(c_next);
             }
+
+            // Values left 'other' without a remove(), keep its size() honest
+            other.num_removes.add(taken);
+
+            return merged;
         }
 
+        struct Stats
+        {
+            int64_t size;
+            int64_t inserts;
+            int64_t removes;
+        };
+
+        // Number of logically present values. Cheap to call from any thread,
+        // but only approximate while updates are in flight.
+        size_t size() const
+        {
+            int64_t n = num_inserts.approx() - num_removes.approx();
+            return (n > 0) ? n : 0;
+        }
+
+        // Successful insert/remove counts, each read with a consistent
+        // (double-collect) snapshot. Exact when no updates are in flight.
+        Stats stats() const
+        {
+            Stats s;
+            s.removes = num_removes.exact();
+            s.inserts = num_inserts.exact();
+            s.size = s.inserts - s.removes;
+            return s;
+        }
 
         void print()
         {
@@ -245,6 +328,88 @@ class LazyList
         }
 
     private:
-        Node* head;
-        Node* tail;
+        // Links a fresh 'node' in place, fails if its value is already present
+        bool link(Node* node, Node* hint = nullptr)
+        {
+            Node* right = nullptr, *left = nullptr;
+
+            while(true)
+            {
+                right = search(node->value, &left, hint);
+                if(right != tail && right->value == node->value)
+                    return false;
+
+                node->next = right;
+                if(__sync_val_compare_and_swap(&(left->next), right, node) == right)
+                {
+                    num_inserts.increment();
+                    return true;
+                }
+            }
+        }
+
+        // Unlinks every run of marked nodes that overlaps [lo, hi], one CAS
+        // per run, handing the unlinked nodes to 'removed'. The walk starts at
+        // 'start', the predecessor of 'lo' remove_range() already searched
+        // for, and only falls back to 'head' once that has been removed.
+        void unlink_range(Node* start, uintptr_t lo, uintptr_t hi, std::vector<Node*>* removed)
+        {
+            Node *left, *left_next, *c, *last;
+
+            auto rescan = [&]() {
+                left = start;
+                left_next = load_next(start);
+                if(is_marked(left_next))
+                {
+                    left = head;
+                    left_next = load_next(head);
+                }
+
+                c = get_unmarked(left_next);
+                last = nullptr;
+            };
+
+            rescan();
+
+            while(true)
+            {
+                // Skip over logically removed nodes, 'left' stays the last live one
+                Node* c_next = (c != tail) ? load_next(c) : nullptr;
+                if(is_marked(c_next))
+                {
+                    last = c;
+                    c = get_unmarked(c_next);
+                    continue;
+                }
+
+                // Runs wholly below 'lo' belong to some other remover
+                if(left_next != c && left_next->value <= hi && last->value >= lo)
+                {
+                    if(__sync_val_compare_and_swap(&(left->next), left_next, c) != left_next)
+                    {
+                        // Lost a race on 'left', rescan
+                        rescan();
+                        continue;
+                    }
+
+                    for(Node* r = left_next; r != c; r = get_unmarked(load_next(r)))
+                        removed->push_back(r);
+                }
+
+                if(c == tail || c->value > hi)
+                    return;
+
+                // 'c_next' was read unmarked, so a CAS expecting it can never
+                // revive 'left' if it gets removed in the meantime
+                left = c;
+                left_next = c_next;
+                c = c_next;
+                last = nullptr;
+            }
+        }
+
+        // Bumped right after each successful linearizing CAS, sharded so that
+        // add/remove don't all hit the same cache line
+        ShardedCounter num_inserts;
+        ShardedCounter num_removes;
 };
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "lazy_list.hpp"
+
+// On-disk snapshot of a LazyList
+//
+// Layout (native endianness):
+//   uint64_t magic
+//   uint64_t count
+//   uint64_t keys[count]   (strictly ascending)
+//
+// Loading maps the file read-only and hands the keys straight to LazyList's
+// bulk-load constructor, so a restart is a single linear pass instead of one
+// search from 'head' per key:
+//
+//   LazyListSnapshot::save(list, "list.snap");
+//   ...
+//   LazyListSnapshot snap("list.snap");
+//   LazyList list(snap.begin(), snap.end());
+//
+// Errors are reported by throwing std::runtime_error.
+
+class LazyListSnapshot
+{
+    public:
+        static const uint64_t MAGIC = 0x31504e534c5a414cull; // "LAZLSNP1"
+
+        // Writes to '<path>.tmp' first, syncs it to disk and only then renames
+        // over 'path', so a crash never leaves a truncated snapshot behind
+        // (it may leave the previous one). Concurrent updates may or may not
+        // be captured.
+        static void save(const LazyList& list, const char* path)
+        {
+            std::string tmp_path = std::string(path) + ".tmp";
+            FILE* f = fopen(tmp_path.c_str(), "wb");
+            if(!f)
+                throw std::runtime_error("Unable to create snapshot file " + tmp_path);
+
+            // Count isn't known until the walk is done, patch it in afterwards
+            uint64_t header[2] = { MAGIC, 0 };
+            bool ok = fwrite(header, sizeof(header), 1, f) == 1;
+
+            for(auto itr = list.begin(); ok && itr != list.end(); ++itr)
+            {
+                uint64_t key = *itr;
+                ok = fwrite(&key, sizeof(key), 1, f) == 1;
+                header[1]++;
+            }
+
+            ok = ok && fseek(f, 0, SEEK_SET) == 0;
+            ok = ok && fwrite(header, sizeof(header), 1, f) == 1;
+
+            // Otherwise the rename can reach the disk before the data does
+            ok = ok && fflush(f) == 0 && fsync(fileno(f)) == 0;
+            ok = (fclose(f) == 0) && ok;
+
+            if(!ok || rename(tmp_path.c_str(), path) != 0)
+            {
+                ::remove(tmp_path.c_str());
+                throw std::runtime_error(std::string("Unable to write snapshot file ") + path);
+            }
+        }
+
+        explicit LazyListSnapshot(const char* path)
+            : fd(-1), mapping(nullptr), length(0)
+        {
+            fd = open(path, O_RDONLY);
+            if(fd < 0)
+                throw std::runtime_error(std::string("Unable to open snapshot file ") + path);
+
+            struct stat st;
+            if(fstat(fd, &st) != 0 || st.st_size < (off_t)(2 * sizeof(uint64_t)))
+            {
+                close(fd);
+                throw std::runtime_error(std::string("Snapshot file is truncated: ") + path);
+            }
+
+            length = st.st_size;
+            mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(mapping == MAP_FAILED)
+            {
+                close(fd);
+                throw std::runtime_error(std::string("Unable to map snapshot file ") + path);
+            }
+
+            // The loader reads front to back exactly once
+            madvise(mapping, length, MADV_SEQUENTIAL);
+
+            const uint64_t* header = static_cast<const uint64_t*>(mapping);
+            if(header[0] != MAGIC ||
+               header[1] != (length / sizeof(uint64_t)) - 2 ||
+               length % sizeof(uint64_t) != 0)
+            {
+                munmap(mapping, length);
+                close(fd);
+                throw std::runtime_error(std::string("Snapshot file is corrupt: ") + path);
+            }
+        }
+
+        ~LazyListSnapshot()
+        {
+            munmap(mapping, length);
+            close(fd);
+        }
+
+        LazyListSnapshot(const LazyListSnapshot&) = delete;
+        LazyListSnapshot& operator=(const LazyListSnapshot&) = delete;
+
+        uint64_t size() const { return static_cast<const uint64_t*>(mapping)[1]; }
+
+        const uint64_t* begin() const { return static_cast<const uint64_t*>(mapping) + 2; }
+        const uint64_t* end() const { return begin() + size(); }
+
+    private:
+        int fd;
+        void* mapping;
+        size_t length;
+};
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "harris_list.hpp"
+
+// Key-value variant of LazyList
+//
+// Same Harris-style sorted list, sharing its traversal with LazyList through
+// HarrisList, but each node carries an atomic value that is updated in place.
+// Upserts locate the node and either update it or link a new one within a
+// single traversal, instead of contains() followed by add().
+//
+// An in-place update only happens on a node that search() observed unmarked
+// during the operation, so it linearizes before any concurrent removal of
+// that node.
+
+template <typename V>
+class MapNode
+{
+    public:
+        MapNode(uintptr_t k, V v) : next(nullptr), key(k), value(v) {}
+
+        MapNode* next;
+
+        uintptr_t key;
+        std::atomic<V> value;
+};
+
+template <typename V = uintptr_t>
+class LazyMap : public HarrisList<MapNode<V>, &MapNode<V>::key>
+{
+    typedef HarrisList<MapNode<V>, &MapNode<V>::key> Base;
+
+    public:
+        typedef MapNode<V> Node;
+
+        using Base::is_marked;
+        using Base::get_unmarked;
+        using Base::get_marked;
+        using Base::load_next;
+        using Base::search;
+        using Base::prune;
+
+        LazyMap()
+            : Base(new Node(0, V()), new Node(std::numeric_limits<uintptr_t>::max(), V()))
+        {}
+
+        LazyMap(const LazyMap&) = delete;
+        LazyMap& operator=(const LazyMap&) = delete;
+
+        ~LazyMap()
+        {
+            Node* c = head;
+            while(c)
+            {
+                Node* n = get_unmarked(c->next);
+                delete c;
+                c = n;
+            }
+        }
+
+        // Searches for given key in map, and can return its current value
+        bool contains(uintptr_t key, V* value = nullptr)
+        {
+            Node* n = this->find(key);
+            if(n && value)
+                *value = n->value.load();
+
+            return n != nullptr;
+        }
+
+        // Inserts if absent, returns false (and leaves the value alone) otherwise
+        bool insert(uintptr_t key, V value)
+        {
+            return upsert(key, value, [](std::atomic<V>&) {});
+        }
+
+        // Returns true if a new node was inserted, false if an existing value
+        // was overwritten
+        bool insert_or_assign(uintptr_t key, V value)
+        {
+            return upsert(key, value, [&](std::atomic<V>& v) { v.store(value); });
+        }
+
+        // Atomically adds 'delta' to the value for 'key', inserting 'delta' if
+        // the key is absent. Returns the previous value, or V() if inserted.
+        V fetch_add(uintptr_t key, V delta)
+        {
+            V old = V();
+            upsert(key, delta, [&](std::atomic<V>& v) { old = v.fetch_add(delta); });
+            return old;
+        }
+
+        // Atomically replaces the value for 'key' with f(value), retrying 'f'
+        // if the value changes underneath it. Returns false if 'key' is absent,
+        // otherwise stores the new value in 'result' when given.
+        template <typename F>
+        bool compute_if_present(uintptr_t key, F f, V* result = nullptr)
+        {
+            Node* left = nullptr;
+            Node* right = search(key, &left);
+            if(right == tail || right->key != key)
+                return false;
+
+            V expected = right->value.load();
+            V desired = f(expected);
+            while(!right->value.compare_exchange_weak(expected, desired))
+            {
+                desired = f(expected);
+            }
+
+            if(result)
+                *result = desired;
+
+            return true;
+        }
+
+        // Logically and/or physically removes node from map, see
+        // LazyList::remove() for the caveats of not pruning and for who ends
+        // up owning the pruned nodes.
+        bool remove(uintptr_t key, std::vector<Node*>* removed = nullptr)
+        {
+            if(!this->mark(key))
+                return false;
+
+            if(removed)
+            {
+                prune(key, removed);
+            }
+
+            return true;
+        }
+
+    private:
+        // Single traversal: if 'key' is present, apply 'update' to its value
+        // in place, otherwise link in a new node holding 'initial'. Returns
+        // true if a node was inserted.
+        template <typename F>
+        bool upsert(uintptr_t key, V initial, F update)
+        {
+            Node* right = nullptr, *left = nullptr;
+            Node* node = nullptr;
+
+            while(true)
+            {
+                right = search(key, &left);
+                if(right != tail && right->key == key)
+                {
+                    delete node;
+                    update(right->value);
+                    return false;
+                }
+
+                // Only allocate once we know we're going to insert
+                if(!node)
+                    node = new Node(key, initial);
+
+                node->next = right;
+                if(__sync_val_compare_and_swap(&(left->next), right, node) == right)
+                {
+                    return true;
+                }
+            }
+        }
+
+        using Base::head;
+        using Base::tail;
+};
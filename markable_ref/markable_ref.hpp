@@ -8,6 +8,9 @@ template <typename T>
 class MarkableReference
 {
 public:
+    // Null, unmarked reference. Lets MarkableReference be used in arrays.
+    MarkableReference() : m_reference(0) {}
+
     // Take ownership of 'ref', when this object is destroyed so is the 
     // current reference.
     MarkableReference(T* ref, bool init_mark)
@@ -46,6 +49,13 @@ public:
 
     inline uintptr_t raw() { return m_reference.load(); }
 
+    // Unconditionally sets the mark, whatever the reference currently is,
+    // and returns the raw value (reference | mark) it replaced.
+    uintptr_t fetchAndMark()
+    {
+        return m_reference.fetch_or(0x1);
+    }
+
     bool compareAndSwap(uintptr_t expected, uintptr_t new_value)
     {
         return m_reference.compare_exchange_strong(expected, new_value);
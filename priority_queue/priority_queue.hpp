@@ -0,0 +1,300 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+
+#include "markable_ref.hpp"
+
+// A Lock-Free, Skip-List Based Priority Queue
+// Derived from: "A Skiplist-Based Concurrent Priority Queue with Minimal Memory
+// Contention" by Jonatan Lindén & Bengt Jonsson
+//
+// A node is logically deleted by marking the level-0 'next' of its
+// predecessor, so the deleted nodes always form a prefix of the list.
+// remove_min() walks that prefix and claims the first unmarked successor
+// with a single fetch-and-or. Only once the prefix grows past
+// 'bound_offset' nodes does one remover swing 'head' past it (a single CAS)
+// and fix up the upper levels, batching physical deletion.
+//
+// Unlinked nodes may still be referenced by concurrent operations, so they
+// are put on a retired list and only freed by reclaim() or the destructor.
+
+class PQNode
+{
+    public:
+        PQNode(uintptr_t k, uintptr_t v, uint32_t l)
+            : key(k), value(v), level(l), inserting(true),
+              next(new MarkableReference<PQNode>[l]), retired_next(nullptr)
+        {}
+
+        ~PQNode()
+        {
+            // MarkableReference deletes whatever it points at, which here is
+            // the rest of the queue. Let go of the successors first.
+            for(uint32_t i = 0; i < level; i++)
+                next[i].set(nullptr, false);
+
+            delete[] next;
+        }
+
+        uintptr_t key;
+        uintptr_t value;
+
+        uint32_t level;
+        std::atomic<bool> inserting;
+
+        MarkableReference<PQNode>* next;
+
+        PQNode* retired_next;
+};
+
+class PriorityQueue
+{
+    public:
+        static const uint32_t MAX_LEVEL = 24;
+
+        explicit PriorityQueue(uint32_t bound = 32)
+            : head(new PQNode(0, 0, MAX_LEVEL)),
+              tail(new PQNode(std::numeric_limits<uintptr_t>::max(), 0, MAX_LEVEL)),
+              bound_offset(bound),
+              retired(nullptr)
+        {
+            head->inserting = false;
+            tail->inserting = false;
+            for(uint32_t i = 0; i < MAX_LEVEL; i++)
+                head->next[i].set(tail, false);
+        }
+
+        PriorityQueue(const PriorityQueue&) = delete;
+        PriorityQueue& operator=(const PriorityQueue&) = delete;
+
+        ~PriorityQueue()
+        {
+            PQNode* c = head;
+            while(c)
+            {
+                PQNode* n = c->next[0].reference();
+                delete c;
+                c = n;
+            }
+
+            reclaim();
+        }
+
+        // Keys must be below std::numeric_limits<uintptr_t>::max(), duplicates
+        // are allowed.
+        void insert(uintptr_t key, uintptr_t value)
+        {
+            PQNode* preds[MAX_LEVEL];
+            PQNode* succs[MAX_LEVEL];
+
+            uint32_t height = random_level();
+            PQNode* node = new PQNode(key, value, height);
+
+            PQNode* del = nullptr;
+            do
+            {
+                del = locate_preds(key, preds, succs);
+                node->next[0].set(succs[0], false);
+            } while(!preds[0]->next[0].compareAndSet(succs[0], node, false, false));
+
+            // Linked in at level 0, so it is in the queue. The upper levels are
+            // only an index, give up on them if the node gets deleted meanwhile.
+            uint32_t i = 1;
+            while(i < height)
+            {
+                node->next[i].set(succs[i], false);
+
+                if(node->next[0].is_marked() || succs[i]->next[0].is_marked() || del == succs[i])
+                    break;
+
+                if(preds[i]->next[i].compareAndSet(succs[i], node, false, false))
+                {
+                    i++;
+                }
+                else
+                {
+                    del = locate_preds(key, preds, succs);
+                    if(succs[0] != node)
+                        break;
+                }
+            }
+
+            node->inserting = false;
+        }
+
+        // Removes an entry with the smallest key, returns false if empty
+        bool remove_min(uintptr_t& key, uintptr_t& value)
+        {
+            PQNode* x = head;
+            PQNode* new_head = nullptr;
+            uint32_t offset = 0;
+
+            uintptr_t obs_head = head->next[0].raw();
+            uintptr_t nxt = 0;
+
+            do
+            {
+                nxt = x->next[0].raw();
+                if(get_ref(nxt) == tail)
+                    return false;
+
+                // Can't cut the prefix past a node whose upper levels are still
+                // being linked in
+                if(new_head == nullptr && x->inserting)
+                    new_head = x;
+
+                nxt = x->next[0].fetchAndMark();
+                offset++;
+                x = get_ref(nxt);
+            } while(nxt & 0x1);
+
+            key = x->key;
+            value = x->value;
+
+            if(offset < bound_offset)
+                return true;
+
+            if(new_head == nullptr)
+                new_head = x;
+
+            // Swing 'head' past the deleted prefix, keeping 'new_head' as the
+            // first (already deleted) node. The winner retires what it cut.
+            if(head->next[0].compareAndSwap(obs_head, reinterpret_cast<uintptr_t>(new_head) | 0x1))
+            {
+                restructure();
+
+                PQNode* c = get_ref(obs_head);
+                while(c != new_head)
+                {
+                    PQNode* n = c->next[0].reference();
+                    retire(c);
+                    c = n;
+                }
+            }
+
+            return true;
+        }
+
+        bool empty()
+        {
+            // Skip the deleted prefix
+            PQNode* x = head;
+            uintptr_t nxt = x->next[0].raw();
+            while(nxt & 0x1)
+            {
+                x = get_ref(nxt);
+                nxt = x->next[0].raw();
+            }
+
+            return get_ref(nxt) == tail;
+        }
+
+        // Frees nodes cut out of the queue by remove_min(). Only call this
+        // while no other thread is using the queue.
+        void reclaim()
+        {
+            PQNode* c = retired.exchange(nullptr);
+            while(c)
+            {
+                PQNode* n = c->retired_next;
+                delete c;
+                c = n;
+            }
+        }
+
+    private:
+        static inline PQNode* get_ref(uintptr_t raw)
+        {
+            return reinterpret_cast<PQNode*>(raw & ~0x1ull);
+        }
+
+        // Fills in the predecessor/successor of 'key' at every level, skipping
+        // the deleted prefix at level 0. Returns the last deleted node seen.
+        PQNode* locate_preds(uintptr_t key, PQNode** preds, PQNode** succs)
+        {
+            PQNode* x = head;
+            PQNode* del = nullptr;
+
+            for(int i = MAX_LEVEL - 1; i >= 0; i--)
+            {
+                bool d = false;
+                PQNode* cur = x->next[i].get(d);
+
+                while(cur->key < key || cur->next[0].is_marked() || (i == 0 && d))
+                {
+                    if(i == 0 && d)
+                        del = cur;
+
+                    x = cur;
+                    cur = x->next[i].get(d);
+                }
+
+                preds[i] = x;
+                succs[i] = cur;
+            }
+
+            return del;
+        }
+
+        // Points the upper levels of 'head' past nodes that have been cut
+        // out of level 0
+        void restructure()
+        {
+            PQNode* pred = head;
+            int i = MAX_LEVEL - 1;
+
+            while(i > 0)
+            {
+                PQNode* h = head->next[i].reference();
+                PQNode* cur = pred->next[i].reference();
+
+                if(!h->next[0].is_marked())
+                {
+                    i--;
+                    continue;
+                }
+
+                while(cur->next[0].is_marked())
+                {
+                    pred = cur;
+                    cur = pred->next[i].reference();
+                }
+
+                if(head->next[i].compareAndSet(h, pred->next[i].reference(), false, false))
+                    i--;
+            }
+        }
+
+        void retire(PQNode* n)
+        {
+            PQNode* top = retired.load();
+            do
+            {
+                n->retired_next = top;
+            } while(!retired.compare_exchange_weak(top, n));
+        }
+
+        // Geometric distribution, p = 1/2
+        static uint32_t random_level()
+        {
+            static std::atomic<uint64_t> seed_source(0x9E3779B97F4A7C15ull);
+            static thread_local uint64_t seed = seed_source.fetch_add(0x9E3779B97F4A7C15ull);
+
+            // xorshift64
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+
+            uint32_t level = 1 + __builtin_ctzll(~seed);
+            return (level < MAX_LEVEL) ? level : MAX_LEVEL;
+        }
+
+        PQNode* head;
+        PQNode* tail;
+
+        uint32_t bound_offset;
+
+        std::atomic<PQNode*> retired;
+};
@@ -74,6 +74,10 @@ void l_remove(uintptr_t* values, bool* results, uint32_t num_values)
     std::unique_lock<std::mutex> cv_l(startup_lock);
     while(!ready) { cv.wait(cv_l); }
 
+#ifndef STD_LIST
+    std::vector<Node*> pruned;
+#endif
+
     for(uint32_t i = 0; i < num_values; i++)
     {
 #ifdef STD_LIST
@@ -83,9 +87,9 @@ void l_remove(uintptr_t* values, bool* results, uint32_t num_values)
         results[i] = false;
         list_lock.unlock();
 #else
-        Node* r;
-        results[i] = lazy_list.remove(values[i], &r);
-        if(results[i])
+        pruned.clear();
+        results[i] = lazy_list.remove(values[i], &pruned);
+        for(Node* r : pruned)
             delete r;
 #endif
     }
@@ -293,7 +297,13 @@ int main(int argc, char** argv)
 #ifdef DEBUG
     printf("Number of elements in list after sort/unique: %d\n", num_list_elems);
 #endif
+#else
+    num_list_elems = lazy_list.size();
+#ifdef DEBUG
+    printf("Number of elements in list at end of test: %d\n", num_list_elems);
+#endif
 #endif
+    (void)num_list_elems;
 
     for(uint32_t i = 0; i < num_threads; i++)
     {
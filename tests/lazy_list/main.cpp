@@ -1,8 +1,14 @@
 #include "lazy_list.hpp"
+#include "lazy_list_snapshot.hpp"
 
 #include <cstdio>
 
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <string>
 #include <thread>
+#include <vector>
 #include <mutex>
 #include <condition_variable>
 
@@ -29,15 +35,15 @@ int main(int argc, char** argv)
         printf("a done\n");
     };
 
-    auto list_remove = [&](int num_ops, uintptr_t* ops) {
+    // Pruned nodes are only freed once every thread is done with the list
+    auto list_remove = [&](int num_ops, uintptr_t* ops, std::vector<Node*>* pruned) {
         std::unique_lock<std::mutex> l(lock);
 
         while(!ready) { cv.wait(l); }
 
         for(int i = 0; i < num_ops; i++)
         {
-            Node* l;
-            ll.remove(ops[i], &l);
+            ll.remove(ops[i], pruned);
         }
 
         printf("r done\n");
@@ -53,10 +59,11 @@ int main(int argc, char** argv)
     std::thread a3(list_insert, 5, ops3);
     std::thread a4(list_insert, 5, ops4);
 
-    std::thread d1(list_remove, 5, ops4);
-    std::thread d2(list_remove, 5, ops3);
-    std::thread d3(list_remove, 5, ops2);
-    std::thread d4(list_remove, 5, ops1);
+    std::vector<Node*> pruned_by[4];
+    std::thread d1(list_remove, 5, ops4, &pruned_by[0]);
+    std::thread d2(list_remove, 5, ops3, &pruned_by[1]);
+    std::thread d3(list_remove, 5, ops2, &pruned_by[2]);
+    std::thread d4(list_remove, 5, ops1, &pruned_by[3]);
 
     lock.lock();
     ready = true;
@@ -73,7 +80,294 @@ int main(int argc, char** argv)
     d3.join();
     d4.join();
 
+    for(auto& pruned : pruned_by)
+    {
+        for(Node* n : pruned)
+            delete n;
+    }
+
     ll.print();
 
+    uintptr_t prev = 0;
+    for(uintptr_t v : ll)
+    {
+        if(v <= prev)
+        {
+            printf("Iteration out of order!\n");
+            return 1;
+        }
+        prev = v;
+    }
+    auto num_elems = std::distance(ll.begin(), ll.end());
+
+    // Iterate a known list: 1..100 with the multiples of 7 logically
+    // removed but left linked in, as remove() without pruning does
+    LazyList populated;
+    std::vector<uintptr_t> expected;
+    for(uintptr_t v = 1; v <= 100; v++)
+    {
+        populated.add(v);
+        if(v % 7 != 0)
+            expected.push_back(v);
+    }
+
+    for(uintptr_t v = 7; v <= 100; v += 7)
+    {
+        populated.remove(v);
+    }
+
+    // Aggregate straight off the list, no copy-out required
+    auto num_populated = std::distance(populated.begin(), populated.end());
+    auto num_even = std::count_if(populated.begin(), populated.end(), [](uintptr_t v) { return (v & 0x1) == 0; });
+    uintptr_t sum = std::accumulate(populated.begin(), populated.end(), uintptr_t(0));
+    printf("%ld elements (%ld even), sum = %lu\n", (long)num_populated, (long)num_even, sum);
+
+    if(num_populated != 86 || num_even != 43 || sum != 5050 - 7 * (14 * 15 / 2) ||
+       !std::equal(expected.begin(), expected.end(), populated.begin()))
+    {
+        printf("Iteration over a populated list is off!\n");
+        return 1;
+    }
+
+    auto expected_itr = expected.begin();
+    for(uintptr_t v : populated)
+    {
+        if(expected_itr == expected.end() || v != *expected_itr++)
+        {
+            printf("Range-for over a populated list is off!\n");
+            return 1;
+        }
+    }
+
+    if(populated.size() != 86 || populated.stats().size != 86)
+    {
+        printf("Populated list size is off!\n");
+        return 1;
+    }
+
+    LazyList::Stats stats = ll.stats();
+    if(ll.size() != (size_t)num_elems || stats.size != num_elems)
+    {
+        printf("List size is off! (size() = %lu, stats.size = %ld, walked = %ld)\n",
+               ll.size(), (long)stats.size, (long)num_elems);
+        return 1;
+    }
+
+    // Freeze into a read-only index and thaw back, at every size up to past
+    // a full 7-level tree so partial bottom levels are covered too
+    for(uintptr_t n = 0; n <= 130; n++)
+    {
+        LazyList evens_to_n;
+        for(uintptr_t v = 1; v <= n; v++)
+        {
+            evens_to_n.add(2 * v);
+        }
+
+        FrozenList frozen = evens_to_n.freeze();
+        if(frozen.size() != n || frozen.empty() != (n == 0) ||
+           std::distance(frozen.begin(), frozen.end()) != (long)n ||
+           !std::equal(evens_to_n.begin(), evens_to_n.end(), frozen.begin()))
+        {
+            printf("Frozen list of %lu has the wrong contents!\n", n);
+            return 1;
+        }
+
+        for(uintptr_t v = 0; v <= 2 * n + 2; v++)
+        {
+            if(frozen.contains(v) != (v != 0 && v % 2 == 0 && v <= 2 * n))
+            {
+                printf("Frozen list of %lu is wrong about %lu!\n", n, v);
+                return 1;
+            }
+        }
+
+        LazyList thawed(frozen);
+        if(!std::equal(evens_to_n.begin(), evens_to_n.end(), thawed.begin()) ||
+           std::distance(thawed.begin(), thawed.end()) != (long)n)
+        {
+            printf("Thawed list of %lu differs!\n", n);
+            return 1;
+        }
+    }
+
+    // Logically removed nodes don't make it into the frozen index
+    FrozenList frozen = populated.freeze();
+    for(uintptr_t v = 0; v <= 101; v++)
+    {
+        if(frozen.contains(v) != (v != 0 && v <= 100 && v % 7 != 0))
+        {
+            printf("Frozen list disagrees on %lu!\n", v);
+            return 1;
+        }
+    }
+
+    if(frozen.size() != expected.size() || !std::equal(expected.begin(), expected.end(), frozen.begin()))
+    {
+        printf("Frozen populated list differs!\n");
+        return 1;
+    }
+
+    // Round-trip through an on-disk snapshot, populated and empty
+    const char* snap_path = "lazy_list_example.snap";
+    try
+    {
+        LazyListSnapshot::save(populated, snap_path);
+
+        LazyListSnapshot snap(snap_path);
+        LazyList loaded(snap.begin(), snap.end());
+        if(snap.size() != expected.size() ||
+           !std::equal(expected.begin(), expected.end(), snap.begin()) ||
+           !std::equal(expected.begin(), expected.end(), loaded.begin()) ||
+           std::distance(loaded.begin(), loaded.end()) != (long)expected.size())
+        {
+            printf("Loaded list differs!\n");
+            return 1;
+        }
+
+        LazyList empty;
+        LazyListSnapshot::save(empty, snap_path);
+
+        LazyListSnapshot empty_snap(snap_path);
+        if(empty_snap.size() != 0 || empty_snap.begin() != empty_snap.end())
+        {
+            printf("Loaded empty list differs!\n");
+            return 1;
+        }
+    }
+    catch(std::exception& e)
+    {
+        printf("Snapshot failed: %s\n", e.what());
+        return 1;
+    }
+
+    // Damaged snapshots must be rejected, not loaded
+    std::string good;
+    {
+        LazyListSnapshot::save(populated, snap_path);
+        FILE* f = fopen(snap_path, "rb");
+        char buf[4096];
+        size_t n;
+        while(f && (n = fread(buf, 1, sizeof(buf), f)) > 0)
+            good.append(buf, n);
+        if(f)
+            fclose(f);
+    }
+
+    auto loads = [&](const std::string& bytes) {
+        FILE* f = fopen(snap_path, "wb");
+        fwrite(bytes.data(), 1, bytes.size(), f);
+        fclose(f);
+
+        try
+        {
+            LazyListSnapshot snap(snap_path);
+            return true;
+        }
+        catch(std::runtime_error&)
+        {
+            return false;
+        }
+    };
+
+    std::string bad_magic = good;
+    bad_magic[0] ^= 0x1;
+
+    if(good.size() != (2 + expected.size()) * sizeof(uint64_t) || !loads(good) ||
+       loads(good.substr(0, 8)) ||                                  // no room for a header
+       loads(good.substr(0, good.size() - 4)) ||                    // torn last key
+       loads(good.substr(0, good.size() - sizeof(uint64_t))) ||     // count mismatch
+       loads(bad_magic))
+    {
+        printf("Snapshot validation misbehaved!\n");
+        return 1;
+    }
+    std::remove(snap_path);
+
+    try
+    {
+        LazyListSnapshot missing(snap_path);
+        printf("Loaded a missing snapshot!\n");
+        return 1;
+    }
+    catch(std::runtime_error&)
+    {
+    }
+
+    // Bulk eviction and merging
+    LazyList evens, odds;
+    for(uintptr_t v = 1; v <= 100; v++)
+    {
+        (v & 0x1) ? odds.add(v) : evens.add(v);
+    }
+
+    if(evens.merge(odds) != 50 || odds.size() != 0 || odds.begin() != odds.end() ||
+       evens.size() != 100 || std::distance(evens.begin(), evens.end()) != 100)
+    {
+        printf("merge() misbehaved!\n");
+        return 1;
+    }
+
+    std::vector<Node*> evicted;
+    if(evens.remove_range(10, 19, &evicted) != 10 || evicted.size() != 10 ||
+       evens.contains(10) || evens.contains(19) || !evens.contains(9) || !evens.contains(20))
+    {
+        printf("remove_range() misbehaved!\n");
+        return 1;
+    }
+
+    if(evens.clear(&evicted) != 90 || evicted.size() != 100 ||
+       evens.size() != 0 || evens.begin() != evens.end())
+    {
+        printf("clear() misbehaved!\n");
+        return 1;
+    }
+
+    for(Node* n : evicted)
+    {
+        delete n;
+    }
+
+    // remove(16) has marked its node and remove_range(10, 15) has marked its
+    // own but neither has unlinked yet. Whoever prunes first takes the whole
+    // run, the other gets nothing back.
+    LazyList runs;
+    for(uintptr_t v = 1; v <= 20; v++)
+    {
+        runs.add(v);
+    }
+
+    runs.remove(16);
+    runs.remove_range(10, 15);
+
+    std::vector<Node*> pruned, unlinked;
+    if(!runs.prune(16, &pruned) || pruned.size() != 7 ||
+       pruned.front()->value != 10 || pruned.back()->value != 16 ||
+       runs.remove_range(10, 15, &unlinked) != 0 || !unlinked.empty() || runs.prune(16, &pruned) ||
+       runs.contains(16) || !runs.contains(17) || std::distance(runs.begin(), runs.end()) != 13)
+    {
+        printf("prune() lost part of a marked run!\n");
+        return 1;
+    }
+
+    // A marked run below the range belongs to its own remover
+    runs.remove(3);
+    unlinked.clear();
+    if(runs.remove_range(5, 7, &unlinked) != 3 || unlinked.size() != 3 ||
+       unlinked.front()->value != 5 || !runs.prune(3, &pruned) || pruned.back()->value != 3)
+    {
+        printf("remove_range() unlinked outside its range!\n");
+        return 1;
+    }
+
+    for(Node* n : unlinked)
+    {
+        delete n;
+    }
+
+    for(Node* n : pruned)
+    {
+        delete n;
+    }
+
     return 0;
 }
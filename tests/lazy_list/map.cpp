@@ -0,0 +1,86 @@
+#include "lazy_map.hpp"
+
+#include <cstdio>
+
+#include <thread>
+#include <vector>
+
+int main(int argc, char** argv)
+{
+    (void)argc;
+    (void)argv;
+
+    const uint32_t num_threads = 8;
+    const uintptr_t num_keys = 64;
+    const uintptr_t num_rounds = 1000;
+
+    LazyMap<uintptr_t> map;
+
+    // Every thread bumps every key, concurrently inserting the missing ones
+    auto counter = [&]() {
+        for(uintptr_t r = 0; r < num_rounds; r++)
+        {
+            for(uintptr_t k = 1; k <= num_keys; k++)
+            {
+                map.fetch_add(k, 1);
+            }
+        }
+    };
+
+    std::vector<std::thread> ths;
+    for(uint32_t i = 0; i < num_threads; i++)
+    {
+        ths.emplace_back(counter);
+    }
+
+    for(auto& t : ths)
+    {
+        t.join();
+    }
+
+    for(uintptr_t k = 1; k <= num_keys; k++)
+    {
+        uintptr_t v = 0;
+        if(!map.contains(k, &v) || v != num_threads * num_rounds)
+        {
+            printf("Key %lu has count %lu, expected %lu\n", k, v, num_threads * num_rounds);
+            return 1;
+        }
+    }
+
+    if(map.insert(1, 0) || !map.insert(num_keys + 1, 7))
+    {
+        printf("insert() misbehaved!\n");
+        return 1;
+    }
+
+    if(map.insert_or_assign(1, 42) || !map.insert_or_assign(num_keys + 2, 3))
+    {
+        printf("insert_or_assign() misbehaved!\n");
+        return 1;
+    }
+
+    uintptr_t result = 0;
+    if(!map.compute_if_present(1, [](uintptr_t v) { return v * 2; }, &result) || result != 84 ||
+       map.compute_if_present(num_keys + 3, [](uintptr_t v) { return v; }))
+    {
+        printf("compute_if_present() misbehaved!\n");
+        return 1;
+    }
+
+    std::vector<MapNode<uintptr_t>*> removed;
+    if(!map.remove(1, &removed) || removed.size() != 1 || map.contains(1) || map.fetch_add(1, 5) != 0)
+    {
+        printf("remove() misbehaved!\n");
+        return 1;
+    }
+
+    for(auto n : removed)
+    {
+        delete n;
+    }
+
+    printf("map ok\n");
+
+    return 0;
+}
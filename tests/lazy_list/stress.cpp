@@ -0,0 +1,322 @@
+#include "lazy_list.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <set>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Linearizability stress test for LazyList
+//
+// Threads hammer a small range of keys with random add/remove/contains and
+// record every operation with invoke/response stamps taken from one global
+// counter. A stamp order A.response < B.invoke means A really did finish
+// before B started, so the recorded history is a sound (if conservative)
+// picture of real time.
+//
+// A set is P-compositional: the history is linearizable iff the
+// sub-history of each key is linearizable against a single boolean
+// "present" flag. Each key is checked separately with Wing & Gong's search,
+// memoized on (linearized ops, state) as suggested by Lowe.
+//
+// A watchdog thread fails the run if the global counter stops moving for
+// WATCHDOG_SECONDS while workers are running, so a livelock is reported
+// instead of hanging.
+//
+// Usage: ./stress [num threads] [ops per thread] [rounds] [seed]
+
+enum OpType { OP_ADD, OP_REMOVE, OP_CONTAINS };
+
+static const char* op_names[] = { "add", "remove", "contains" };
+
+struct Op
+{
+    OpType type;
+    uintptr_t key;
+    bool result;
+    uint64_t invoke;
+    uint64_t response;
+};
+
+struct ThreadStatus
+{
+    std::atomic<uint64_t> completed;
+    std::atomic<int> type;
+    std::atomic<uintptr_t> key;
+};
+
+static const uintptr_t NUM_KEYS = 8;
+static const uint32_t WATCHDOG_SECONDS = 10;
+
+static std::atomic<uint64_t> clock_ticks(0);
+
+// Checks one key's history, 'ops' all start on an absent key
+static bool check_key(const std::vector<Op>& ops)
+{
+    // Call/return events in stamp order, as a doubly linked list so
+    // linearized ops can be lifted out and put back (dancing links).
+    // Entry 0 is the head sentinel, 'end' the tail sentinel, the call of
+    // op i is entry 1 + 2i and its return 2 + 2i.
+    const size_t n = ops.size();
+    const size_t end = 2 * n + 1;
+
+    std::vector<std::pair<uint64_t, size_t>> events;
+    for(size_t i = 0; i < n; i++)
+    {
+        events.emplace_back(ops[i].invoke, 1 + 2 * i);
+        events.emplace_back(ops[i].response, 2 + 2 * i);
+    }
+    std::sort(events.begin(), events.end());
+
+    std::vector<size_t> next(end + 1, end), prev(end + 1, 0);
+    size_t last = 0;
+    for(auto& e : events)
+    {
+        next[last] = e.second;
+        prev[e.second] = last;
+        last = e.second;
+    }
+    next[last] = end;
+    prev[end] = last;
+
+    auto unlink = [&](size_t e) { next[prev[e]] = next[e]; prev[next[e]] = prev[e]; };
+    auto relink = [&](size_t e) { next[prev[e]] = e; prev[next[e]] = e; };
+
+    std::vector<uint64_t> linearized((n + 63) / 64, 0);
+    std::set<std::pair<std::vector<uint64_t>, bool>> seen;
+
+    // (op, state before it) for every tentatively linearized op
+    std::vector<std::pair<size_t, bool>> calls;
+    bool present = false;
+
+    size_t entry = next[0];
+    while(next[0] != end)
+    {
+        if(entry % 2 == 1)
+        {
+            size_t i = (entry - 1) / 2;
+            const Op& op = ops[i];
+
+            bool expected = (op.type == OP_ADD) ? !present : present;
+            bool after = (op.type == OP_ADD) ? true : (op.type == OP_REMOVE) ? false : present;
+
+            if(op.result == expected)
+            {
+                linearized[i / 64] |= (1ull << (i % 64));
+                if(seen.insert(std::make_pair(linearized, after)).second)
+                {
+                    calls.emplace_back(i, present);
+                    present = after;
+                    unlink(entry);
+                    unlink(entry + 1);
+                    entry = next[0];
+                    continue;
+                }
+                linearized[i / 64] &= ~(1ull << (i % 64));
+            }
+
+            entry = next[entry];
+        }
+        else
+        {
+            // Reached a return whose call can't be linearized yet, undo the
+            // most recent choice and try the next candidate
+            if(calls.empty())
+                return false;
+
+            size_t i = calls.back().first;
+            present = calls.back().second;
+            calls.pop_back();
+
+            linearized[i / 64] &= ~(1ull << (i % 64));
+            relink(2 + 2 * i);
+            relink(1 + 2 * i);
+            entry = next[1 + 2 * i];
+        }
+    }
+
+    return true;
+}
+
+static void dump_history(const std::vector<Op>& ops)
+{
+    for(auto& op : ops)
+    {
+        printf("  [%8lu, %8lu] %s(%lu) -> %s\n", op.invoke, op.response,
+               op_names[op.type], op.key, op.result ? "true" : "false");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t num_threads = (argc > 1) ? atoi(argv[1]) : 4;
+    uint32_t num_ops = (argc > 2) ? atoi(argv[2]) : 2000;
+    uint32_t num_rounds = (argc > 3) ? atoi(argv[3]) : 50;
+    uint64_t seed = (argc > 4) ? strtoull(argv[4], nullptr, 0)
+                               : std::chrono::steady_clock::now().time_since_epoch().count();
+
+    if(num_threads == 0 || num_ops == 0)
+    {
+        printf("Usage: %s [num threads] [ops per thread] [rounds] [seed]\n", argv[0]);
+        return 1;
+    }
+
+    printf("Stress: %u threads, %u ops/thread, %u rounds, seed %lu\n",
+           num_threads, num_ops, num_rounds, seed);
+
+    std::vector<ThreadStatus> status(num_threads);
+    std::atomic<uint32_t> round(0);
+    std::atomic<bool> running(false);
+    std::atomic<bool> finished(false);
+
+    std::thread watchdog([&]() {
+        uint64_t last_ticks = clock_ticks.load();
+        auto last_change = std::chrono::steady_clock::now();
+
+        while(!finished.load())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+            auto now = std::chrono::steady_clock::now();
+            uint64_t ticks = clock_ticks.load();
+            if(!running.load() || ticks != last_ticks)
+            {
+                last_ticks = ticks;
+                last_change = now;
+                continue;
+            }
+
+            if(now - last_change < std::chrono::seconds(WATCHDOG_SECONDS))
+                continue;
+
+            printf("No progress for %us in round %u (seed %lu), livelock?\n",
+                   WATCHDOG_SECONDS, round.load(), seed);
+            for(uint32_t t = 0; t < num_threads; t++)
+            {
+                printf("  thread %u: %lu ops done, last %s(%lu)\n", t,
+                       status[t].completed.load(), op_names[status[t].type.load()],
+                       status[t].key.load());
+            }
+
+            fflush(stdout);
+            std::_Exit(2);
+        }
+    });
+
+    bool ok = true;
+    for(uint32_t r = 0; ok && r < num_rounds; r++)
+    {
+        round = r;
+
+        LazyList ll;
+        std::vector<std::vector<Op>> histories(num_threads);
+        std::vector<std::vector<Node*>> removed(num_threads);
+        std::atomic<uint32_t> started(0);
+
+        auto worker = [&](uint32_t t) {
+            std::mt19937_64 rng(seed ^ (0x9E3779B97F4A7C15ull * (r * num_threads + t + 1)));
+            std::vector<Op>& history = histories[t];
+            history.reserve(num_ops);
+
+            status[t].completed = 0;
+
+            // Line everyone up so the operations actually overlap
+            started++;
+            while(started.load() < num_threads)
+                std::this_thread::yield();
+
+            for(uint32_t i = 0; i < num_ops; i++)
+            {
+                Op op;
+                uint64_t dice = rng() % 10;
+                op.type = (dice < 4) ? OP_ADD : (dice < 8) ? OP_REMOVE : OP_CONTAINS;
+                op.key = 1 + rng() % NUM_KEYS;
+
+                status[t].type = op.type;
+                status[t].key = op.key;
+
+                op.invoke = clock_ticks++;
+                if(op.type == OP_ADD)
+                {
+                    op.result = ll.add(op.key);
+                }
+                else if(op.type == OP_REMOVE)
+                {
+                    // Always prune, an unpruned node stalls everyone else
+                    op.result = ll.remove(op.key, &removed[t]);
+                }
+                else
+                {
+                    op.result = ll.contains(op.key);
+                }
+                op.response = clock_ticks++;
+
+                history.push_back(op);
+                status[t].completed++;
+            }
+        };
+
+        running = true;
+
+        std::vector<std::thread> ths;
+        for(uint32_t t = 0; t < num_threads; t++)
+        {
+            ths.emplace_back(worker, t);
+        }
+
+        for(auto& t : ths)
+        {
+            t.join();
+        }
+
+        running = false;
+
+        // Split by key, closing each history with the key's final state
+        std::vector<std::vector<Op>> per_key(NUM_KEYS + 1);
+        for(auto& history : histories)
+        {
+            for(auto& op : history)
+                per_key[op.key].push_back(op);
+        }
+
+        for(uintptr_t k = 1; k <= NUM_KEYS; k++)
+        {
+            Op final_op;
+            final_op.type = OP_CONTAINS;
+            final_op.key = k;
+            final_op.invoke = clock_ticks++;
+            final_op.result = ll.contains(k);
+            final_op.response = clock_ticks++;
+            per_key[k].push_back(final_op);
+
+            if(!check_key(per_key[k]))
+            {
+                printf("Round %u: history for key %lu is not linearizable (seed %lu)\n", r, k, seed);
+                dump_history(per_key[k]);
+                ok = false;
+                break;
+            }
+        }
+
+        for(auto& nodes : removed)
+        {
+            for(Node* n : nodes)
+                delete n;
+        }
+    }
+
+    finished = true;
+    watchdog.join();
+
+    if(!ok)
+        return 1;
+
+    printf("All %u rounds linearizable\n", num_rounds);
+    return 0;
+}
@@ -39,5 +39,16 @@ int main(int argc, char** argv)
 
     delete t;
 
+    MarkableReference<int> null_ref;
+    if(null_ref.reference() != nullptr || null_ref.is_marked())
+    {
+        return 1;
+    }
+
+    if(null_ref.fetchAndMark() != 0 || !null_ref.is_marked() || null_ref.fetchAndMark() != 0x1)
+    {
+        return 1;
+    }
+
     return 0;
 }
@@ -0,0 +1,211 @@
+// Harness stuff
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <random>
+#include <cstdio>
+#include <string>
+#include <iostream>
+#include <chrono>
+
+// queue implementations
+#include <queue>
+#include <vector>
+#include "priority_queue.hpp"
+
+// Build with -DSTD_PQ for the mutexed std::priority_queue baseline
+//#define STD_PQ
+//#define DEBUG
+
+#ifdef STD_PQ
+std::mutex queue_lock;
+std::priority_queue<uintptr_t, std::vector<uintptr_t>, std::greater<uintptr_t>> queue;
+#else
+PriorityQueue queue;
+#endif
+
+// Test synch stuff
+bool ready = false;
+std::mutex startup_lock;
+std::condition_variable cv;
+
+void q_insert(uintptr_t key)
+{
+#ifdef STD_PQ
+    std::lock_guard<std::mutex> l(queue_lock);
+    queue.push(key);
+#else
+    queue.insert(key, key);
+#endif
+}
+
+bool q_remove_min()
+{
+#ifdef STD_PQ
+    std::lock_guard<std::mutex> l(queue_lock);
+    if(queue.empty())
+        return false;
+
+    queue.pop();
+    return true;
+#else
+    uintptr_t k, v;
+    return queue.remove_min(k, v);
+#endif
+}
+
+void inserter(uintptr_t* values, bool* results, uint32_t num_values)
+{
+    std::unique_lock<std::mutex> cv_l(startup_lock);
+    while(!ready) { cv.wait(cv_l); }
+    cv_l.unlock();
+
+    for(uint32_t i = 0; i < num_values; i++)
+    {
+        q_insert(values[i]);
+        results[i] = true;
+    }
+}
+
+void remover(uintptr_t* values, bool* results, uint32_t num_values)
+{
+    (void)values;
+
+    std::unique_lock<std::mutex> cv_l(startup_lock);
+    while(!ready) { cv.wait(cv_l); }
+    cv_l.unlock();
+
+    for(uint32_t i = 0; i < num_values; i++)
+    {
+        results[i] = q_remove_min();
+    }
+}
+
+// Scheduler-like: every thread re-queues work after taking the next item
+void mixed(uintptr_t* values, bool* results, uint32_t num_values)
+{
+    std::unique_lock<std::mutex> cv_l(startup_lock);
+    while(!ready) { cv.wait(cv_l); }
+    cv_l.unlock();
+
+    for(uint32_t i = 0; i < num_values; i++)
+    {
+        results[i] = q_remove_min();
+        q_insert(values[i]);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(argc < 4)
+    {
+        printf("Not enough arguments!\n");
+        printf("Usage: ./bench <num threads> <num elements> <workload>\n");
+        printf("Workload = 1: 50/50, insert/remove_min threads\n");
+        printf("           2: every thread alternates remove_min/insert\n");
+        return 1;
+    }
+
+    unsigned int num_threads = std::stoul(argv[1]);
+    unsigned int num_elements = std::stoul(argv[2]);
+    unsigned int workload = std::stoul(argv[3]);
+
+    if(workload < 1 || workload > 2)
+    {
+        printf("Invalid workload selection!\n");
+        return 1;
+    }
+
+#ifdef DEBUG
+    printf("Num threads: %u\n", num_threads);
+    printf("Data set size: %u\n", num_elements);
+    printf("Workload: %u\n", workload);
+#endif
+
+    std::random_device rd;
+    std::mt19937 generator(rd());
+    std::uniform_int_distribution<uintptr_t> dist(0, num_elements - 1);
+
+    // Preload the queue
+    for(uint32_t i = 0; i < num_elements; i++)
+    {
+        q_insert(dist(generator));
+    }
+
+    std::thread *ths = new std::thread[num_threads]();
+
+    uintptr_t **value_set = new uintptr_t*[num_threads];
+    bool **result_set = new bool*[num_threads];
+
+    for(uint32_t i = 0; i < num_threads; i++)
+    {
+        value_set[i] = new uintptr_t[num_elements];
+        result_set[i] = new bool[num_elements];
+        for(uint32_t l = 0; l < num_elements; l++)
+        {
+            value_set[i][l] = dist(generator);
+            result_set[i][l] = false;
+        }
+
+        if(workload == 2)
+            ths[i] = std::thread(mixed, value_set[i], result_set[i], num_elements);
+        else if(i < num_threads / 2)
+            ths[i] = std::thread(inserter, value_set[i], result_set[i], num_elements);
+        else
+            ths[i] = std::thread(remover, value_set[i], result_set[i], num_elements);
+    }
+
+    printf("Starting benchmark: ");
+#ifdef STD_PQ
+    printf("std::priority_queue (mutexed)\n");
+#else
+    printf("PriorityQueue (lock-free)\n");
+#endif
+    fflush(stdout);
+
+    startup_lock.lock();
+    ready = true;
+    auto start = std::chrono::steady_clock::now();
+    cv.notify_all();
+    startup_lock.unlock();
+
+    for(uint32_t i = 0; i < num_threads; i++)
+    {
+        ths[i].join();
+    }
+    auto end = std::chrono::steady_clock::now();
+    auto diff = end - start;
+
+    double ms = std::chrono::duration <double, std::milli> (diff).count();
+    std::cout << ms << " ms" << std::endl;
+
+    uint64_t total_ops = (uint64_t)num_threads * num_elements * ((workload == 2) ? 2 : 1);
+    std::cout << (total_ops / ms) * 1000.0 << " ops/s" << std::endl;
+
+#ifdef DEBUG
+    for(uint32_t i = 0; i < num_threads; i++)
+    {
+        int succ_op = 0;
+        for(uint32_t l = 0; l < num_elements; l++)
+        {
+            if(result_set[i][l])
+                succ_op++;
+        }
+
+        printf("Thread %u: %d successful operations\n", i, succ_op);
+    }
+#endif
+
+    // Clean-up
+    for(uint32_t i = 0; i < num_threads; i++)
+    {
+        delete[] value_set[i];
+        delete[] result_set[i];
+    }
+
+    delete[] ths;
+    delete[] value_set;
+    delete[] result_set;
+
+    return 0;
+}
@@ -0,0 +1,168 @@
+#include "priority_queue.hpp"
+
+#include <cstdio>
+
+#include <algorithm>
+#include <atomic>
+#include <queue>
+#include <random>
+#include <thread>
+#include <vector>
+
+int main(int argc, char** argv)
+{
+    (void)argc;
+    (void)argv;
+
+    const uint32_t num_threads = 4;
+    const uintptr_t num_per_thread = 5000;
+
+    // Sequential: interleaved inserts/remove_mins must match std::priority_queue
+    {
+        PriorityQueue pq(4);
+        std::priority_queue<uintptr_t, std::vector<uintptr_t>, std::greater<uintptr_t>> ref;
+        std::mt19937 generator(42);
+
+        for(uint32_t i = 0; i < 20000; i++)
+        {
+            if(generator() % 3 != 0)
+            {
+                uintptr_t k = generator() % 1000;
+                pq.insert(k, k + 1);
+                ref.push(k);
+            }
+            else
+            {
+                uintptr_t k = 0, v = 0;
+                bool got = pq.remove_min(k, v);
+                if(got != !ref.empty() || (got && (k != ref.top() || v != k + 1)))
+                {
+                    printf("remove_min() disagrees with std::priority_queue!\n");
+                    return 1;
+                }
+
+                if(got)
+                    ref.pop();
+            }
+        }
+
+        if(pq.empty() != ref.empty())
+        {
+            printf("empty() disagrees with std::priority_queue!\n");
+            return 1;
+        }
+    }
+
+    // Concurrent: producers insert distinct keys while consumers drain,
+    // retrying until every key has been taken. A small bound makes the head
+    // swing past the deleted prefix often, racing inserts still linking in
+    // their upper levels.
+    //
+    // Stamps from one counter order inserts and removals in time. A
+    // consumer may take a key below one it took earlier only if that key's
+    // insert hadn't finished when the earlier remove_min() started.
+    // Together the consumers must take every key exactly once.
+    const uintptr_t num_keys = num_threads * num_per_thread;
+    PriorityQueue pq(2);
+
+    std::atomic<uint64_t> clock(0);
+    std::atomic<uintptr_t> taken(0);
+    std::atomic<uint32_t> started(0);
+    std::vector<uint64_t> inserted_at(num_keys, 0);
+
+    struct Removal
+    {
+        uintptr_t key;
+        uint64_t invoke;
+    };
+
+    auto line_up = [&]() {
+        started++;
+        while(started.load() < 2 * num_threads)
+            std::this_thread::yield();
+    };
+
+    auto producer = [&](uintptr_t first) {
+        line_up();
+        for(uintptr_t k = first; k < num_keys; k += num_threads)
+        {
+            pq.insert(k, k);
+            inserted_at[k] = clock++;
+        }
+    };
+
+    std::vector<std::vector<Removal>> seen(num_threads);
+    auto consumer = [&](uint32_t id) {
+        line_up();
+        while(taken.load() < num_keys)
+        {
+            uintptr_t k = 0, v = 0;
+            uint64_t invoke = clock++;
+            if(pq.remove_min(k, v))
+            {
+                taken++;
+                seen[id].push_back(Removal{ k, invoke });
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+    };
+
+    std::vector<std::thread> ths;
+    for(uint32_t i = 0; i < num_threads; i++)
+    {
+        ths.emplace_back(producer, i);
+        ths.emplace_back(consumer, i);
+    }
+    for(auto& t : ths)
+        t.join();
+
+    std::vector<uintptr_t> all;
+    for(auto& s : seen)
+    {
+        for(size_t j = 0; j < s.size(); j++)
+        {
+            if(s[j].key >= num_keys)
+            {
+                printf("Consumer took unknown key %lu!\n", s[j].key);
+                return 1;
+            }
+
+            // The latest earlier removal of a bigger key, if any
+            size_t i = j;
+            while(i > 0 && s[i - 1].key < s[j].key)
+                i--;
+
+            if(i > 0 && inserted_at[s[j].key] < s[i - 1].invoke)
+            {
+                printf("Consumer took %lu after %lu, though %lu was already in!\n",
+                       s[j].key, s[i - 1].key, s[j].key);
+                return 1;
+            }
+
+            all.push_back(s[j].key);
+        }
+    }
+
+    std::sort(all.begin(), all.end());
+    for(uintptr_t k = 0; k < all.size(); k++)
+    {
+        if(all[k] != k)
+        {
+            printf("Key %lu lost or duplicated!\n", k);
+            return 1;
+        }
+    }
+
+    if(all.size() != num_keys || !pq.empty())
+    {
+        printf("Drained %zu of %lu keys!\n", all.size(), num_keys);
+        return 1;
+    }
+
+    pq.reclaim();
+
+    return 0;
+}
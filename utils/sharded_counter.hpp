@@ -0,0 +1,107 @@
+#pragma once
+
+// Sharded counter
+//
+// Each thread bumps its own cache-line-sized shard with a relaxed RMW, so
+// writers never contend on a shared line. Readers pay instead, by summing
+// every shard.
+
+#include <atomic>
+#include <cstdint>
+
+class ShardedCounter
+{
+    public:
+        static const uint32_t NUM_SHARDS = 32;
+
+        ShardedCounter()
+        {
+            for(uint32_t i = 0; i < NUM_SHARDS; i++)
+                _shards[i].value.store(0, std::memory_order_relaxed);
+        }
+
+        ShardedCounter(const ShardedCounter&) = delete;
+        ShardedCounter& operator=(const ShardedCounter&) = delete;
+
+        void add(int64_t delta)
+        {
+            _shards[shard_index() % NUM_SHARDS].value.fetch_add(delta, std::memory_order_relaxed);
+        }
+
+        void increment() { add(1); }
+        void decrement() { add(-1); }
+
+        // Cheap read, may miss updates that are racing with it
+        int64_t approx() const
+        {
+            int64_t sum = 0;
+            for(uint32_t i = 0; i < NUM_SHARDS; i++)
+                sum += _shards[i].value.load(std::memory_order_relaxed);
+
+            return sum;
+        }
+
+        // Double-collect: sum the shards only once two consecutive passes
+        // agree on every shard. While the counter only grows, agreement means
+        // the values were all present at the same instant. Once decrement()
+        // or negative deltas are in play, a shard can go up and back down
+        // between passes, so agreement no longer proves that. The sum is
+        // then only exact while writers are quiescent. Gives up after
+        // 'max_retries' disagreeing passes and returns the last one.
+        int64_t exact(uint32_t max_retries = 16) const
+        {
+            int64_t prev[NUM_SHARDS];
+            collect(prev);
+
+            for(uint32_t attempt = 0; attempt < max_retries; attempt++)
+            {
+                int64_t curr[NUM_SHARDS];
+                collect(curr);
+
+                bool same = true;
+                for(uint32_t i = 0; i < NUM_SHARDS; i++)
+                {
+                    same = same && (prev[i] == curr[i]);
+                    prev[i] = curr[i];
+                }
+
+                if(same)
+                    break;
+            }
+
+            int64_t sum = 0;
+            for(uint32_t i = 0; i < NUM_SHARDS; i++)
+                sum += prev[i];
+
+            return sum;
+        }
+
+    private:
+        // Padded so that no two shards' values share a cache line
+        struct Shard
+        {
+            std::atomic<int64_t> value;
+            char pad[64 - sizeof(std::atomic<int64_t>)];
+        };
+
+        // Threads are handed shards round-robin on first use
+        static uint32_t shard_index()
+        {
+            static std::atomic<uint32_t> next_index(0);
+            static thread_local uint32_t index = next_index.fetch_add(1, std::memory_order_relaxed);
+            return index;
+        }
+
+        void collect(int64_t* out) const
+        {
+            for(uint32_t i = 0; i < NUM_SHARDS; i++)
+                out[i] = _shards[i].value.load(std::memory_order_acquire);
+        }
+
+        // Shards are only 8-byte aligned (operator new ignores alignas(64)
+        // before C++17), so pad ahead of the first one too. Otherwise shard
+        // 0's value could share a line with the owner's preceding members,
+        // e.g. LazyList's 'head' and 'tail' that every operation reads.
+        char _lead_pad[64 - sizeof(std::atomic<int64_t>)];
+        Shard _shards[NUM_SHARDS];
+};